@@ -0,0 +1,56 @@
+#include "batch.h"
+#include "reduce.h"
+#include "logging.h"
+
+#include <mpi.h>
+#include <iostream>
+#include <limits>
+
+void runBatch(const std::vector<QueryConfig> &configs,
+              const ScanFilter &scan,
+              const DataVec &owned)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    char host[MPI_MAX_PROCESSOR_NAME];
+    int hostlen;
+    MPI_Get_processor_name(host, &hostlen);
+    std::string hostname(host);
+
+    // ----------------- AGGREGATE -----------------
+    PerfSample p0 = perf_sample();
+    double t0 = MPI_Wtime();
+    auto agg = aggregateByBucket(owned, scan.uncertCuts.size());
+    double t1 = MPI_Wtime();
+    log_event(rank, hostname, size, "batch_aggregate", t0, t1, p0);
+
+    std::cerr
+        << "[rank " << rank << " | " << hostname << "] "
+        << "series=" << agg.size()
+        << " values=" << owned.size()
+        << " buckets=" << scan.uncertCuts.size()
+        << " (batch)"
+        << std::endl;
+
+    // ----------------- EVALUATE -----------------
+    PerfSample p2 = perf_sample();
+    double t2 = MPI_Wtime();
+
+    for (const auto &q : configs) {
+        auto deltas = runQueryMPI(agg, scan, q);
+
+        if (rank == 0) {
+            // threshold и top уже применены в runQueryMPI
+            std::string path = "min_delta_" + q.name + ".txt";
+            writeMinDeltaReport(path, deltas,
+                                std::numeric_limits<double>::lowest(),
+                                q.top, queryValueColumn(q));
+            std::cerr << "[batch] " << q.name << " -> " << path << std::endl;
+        }
+    }
+
+    double t3 = MPI_Wtime();
+    log_event(rank, hostname, size, "batch_evaluate", t2, t3, p2);
+}
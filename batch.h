@@ -0,0 +1,11 @@
+#pragma once
+#include <vector>
+#include "types.h"
+#include "query.h"
+
+// Все конфигурации по одному набору данных (после redistribute):
+// агрегаты строятся один раз, каждая конфигурация пишет
+// min_delta_<name>.txt на rank 0
+void runBatch(const std::vector<QueryConfig> &configs,
+              const ScanFilter &scan,
+              const DataVec &owned);
@@ -0,0 +1,311 @@
+#include "csv_index.h"
+#include "redistribute.h"
+
+#include <mpi.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <unordered_set>
+
+static const char* const INDEX_MAGIC = "# csv-index v1";
+
+std::string csvIndexPath(const std::string &csv)
+{
+    return csv + ".idx";
+}
+
+static bool statFile(const std::string &path, uint64_t &size, int64_t &mtime)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0)
+        return false;
+    size  = static_cast<uint64_t>(st.st_size);
+    mtime = static_cast<int64_t>(st.st_mtime);
+    return true;
+}
+
+// ============================================================================
+// Сериализация (текст: заголовок + key\tbegin\tend\tminYear\tmaxYear)
+// ============================================================================
+
+static std::string serializeIndex(const CsvIndex &index)
+{
+    std::ostringstream out;
+    out << INDEX_MAGIC << ' ' << index.fileSize << ' ' << index.mtime << '\n';
+    for (const auto &r : index.ranges)
+        out << r.key << '\t' << r.begin << '\t' << r.end << '\t'
+            << r.minYear << '\t' << r.maxYear << '\n';
+    return out.str();
+}
+
+static bool parseIndex(const std::string &text, CsvIndex &index)
+{
+    std::istringstream in(text);
+    std::string line;
+
+    if (!std::getline(in, line) || line.rfind(INDEX_MAGIC, 0) != 0)
+        return false;
+
+    std::istringstream hdr(line.substr(std::string(INDEX_MAGIC).size()));
+    if (!(hdr >> index.fileSize >> index.mtime))
+        return false;
+
+    index.ranges.clear();
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+
+        std::stringstream ss(line);
+        IndexRange r;
+        std::string b, e, y0, y1;
+
+        std::getline(ss, r.key, '\t');
+        std::getline(ss, b,  '\t');
+        std::getline(ss, e,  '\t');
+        std::getline(ss, y0, '\t');
+        std::getline(ss, y1, '\t');
+
+        try {
+            r.begin   = std::stoull(b);
+            r.end     = std::stoull(e);
+            r.minYear = std::stoi(y0);
+            r.maxYear = std::stoi(y1);
+        } catch (...) {
+            return false;
+        }
+        index.ranges.push_back(r);
+    }
+    return true;
+}
+
+// ============================================================================
+// Построение (один проход по CSV)
+// ============================================================================
+
+static bool buildIndex(const std::string &csv, CsvIndex &index)
+{
+    std::ifstream file(csv, std::ios::binary);
+    if (!file) return false;
+
+    index.ranges.clear();
+
+    std::string line;
+    std::getline(file, line); // header
+    uint64_t pos = line.size() + 1;
+
+    IndexRange cur;
+    bool open = false;
+
+    while (std::getline(file, line)) {
+        uint64_t lineBegin = pos;
+        pos += line.size() + 1;
+
+        // dt,AverageTemperature,AverageTemperatureUncertainty,City,Country,...
+        std::size_t c1 = line.find(',');
+        std::size_t c2 = c1 == std::string::npos ? c1 : line.find(',', c1 + 1);
+        std::size_t c3 = c2 == std::string::npos ? c2 : line.find(',', c2 + 1);
+        std::size_t c4 = c3 == std::string::npos ? c3 : line.find(',', c3 + 1);
+        if (c4 == std::string::npos) {
+            if (open) cur.end = pos;
+            continue;
+        }
+        std::size_t c5 = line.find(',', c4 + 1);
+
+        std::string city    = line.substr(c3 + 1, c4 - c3 - 1);
+        std::string country = line.substr(c4 + 1,
+            (c5 == std::string::npos ? line.size() : c5) - c4 - 1);
+        std::string key = country + "|" + city;
+
+        int year = 0;
+        bool hasYear = c1 >= 4;
+        if (hasYear) {
+            try { year = std::stoi(line.substr(0, 4)); }
+            catch (...) { hasYear = false; }
+        }
+
+        if (!open || key != cur.key) {
+            if (open) index.ranges.push_back(cur);
+            cur = IndexRange();
+            cur.key     = key;
+            cur.begin   = lineBegin;
+            cur.minYear = INT_MAX;
+            cur.maxYear = INT_MIN;
+            open = true;
+        }
+
+        cur.end = pos;
+        if (hasYear) {
+            cur.minYear = std::min(cur.minYear, year);
+            cur.maxYear = std::max(cur.maxYear, year);
+        }
+    }
+
+    if (open) index.ranges.push_back(cur);
+    return true;
+}
+
+// ============================================================================
+// Загрузка (rank 0) + рассылка
+// ============================================================================
+
+bool loadCsvIndex(const std::string &csv, CsvIndex &index)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    std::string text;
+
+    if (rank == 0) {
+        uint64_t size = 0;
+        int64_t  mtime = 0;
+
+        if (statFile(csv, size, mtime)) {
+            std::string path = csvIndexPath(csv);
+            std::ifstream in(path);
+            std::stringstream buf;
+            buf << in.rdbuf();
+
+            CsvIndex cached;
+            if (in && parseIndex(buf.str(), cached) &&
+                cached.fileSize == size && cached.mtime == mtime) {
+                text = buf.str();
+            } else {
+                double t0 = MPI_Wtime();
+                CsvIndex built;
+                built.fileSize = size;
+                built.mtime    = mtime;
+                if (buildIndex(csv, built)) {
+                    text = serializeIndex(built);
+                    std::ofstream out(path);
+                    out << text;
+                    std::cerr << "[index] built " << path << ": "
+                              << built.ranges.size() << " ranges in "
+                              << MPI_Wtime() - t0 << "s" << std::endl;
+                }
+            }
+        }
+    }
+
+    unsigned long long len = text.size();
+    MPI_Bcast(&len, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    if (len == 0)
+        return false;
+
+    text.resize(len);
+    MPI_Bcast(&text[0], static_cast<int>(len), MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    return parseIndex(text, index);
+}
+
+// ============================================================================
+// Отбор и раскладка диапазонов
+// ============================================================================
+
+static bool contains(const std::vector<std::string> &v, const std::string &s)
+{
+    return std::find(v.begin(), v.end(), s) != v.end();
+}
+
+std::vector<IndexRange>
+selectRanges(const CsvIndex &index, const ScanFilter &filter)
+{
+    std::vector<IndexRange> res;
+
+    for (const auto &r : index.ranges) {
+        auto sep = r.key.find('|');
+        std::string country = r.key.substr(0, sep);
+        std::string city    = r.key.substr(sep + 1);
+
+        if (!filter.countries.empty() && !contains(filter.countries, country))
+            continue;
+        if (!filter.cities.empty() && !contains(filter.cities, city))
+            continue;
+
+        // диапазон без единого года оставляем — его отсеет построчный фильтр
+        if (r.minYear <= r.maxYear &&
+            (r.maxYear < filter.yearFrom || r.minYear > filter.yearTo))
+            continue;
+
+        res.push_back(r);
+    }
+    return res;
+}
+
+std::vector<IndexRange>
+sampleRanges(const std::vector<IndexRange> &ranges,
+             double fraction,
+             unsigned seed)
+{
+    // страна → различные key (у одного key может быть несколько диапазонов)
+    std::map<std::string, std::vector<std::string>> strata;
+    for (const auto &r : ranges)
+        strata[r.key.substr(0, r.key.find('|'))].push_back(r.key);
+
+    std::unordered_set<std::string> chosen;
+
+    for (auto &[country, keys] : strata) {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        std::sort(keys.begin(), keys.end(),
+                  [&](const std::string &a, const std::string &b) {
+                      uint64_t ha = stableHash(a, seed);
+                      uint64_t hb = stableHash(b, seed);
+                      if (ha != hb) return ha < hb;
+                      return a < b;
+                  });
+
+        std::size_t take = static_cast<std::size_t>(
+            std::ceil(fraction * keys.size()));
+        take = std::max<std::size_t>(1, std::min(take, keys.size()));
+
+        chosen.insert(keys.begin(), keys.begin() + take);
+    }
+
+    // выбранная серия читается всеми своими диапазонами — значения точные
+    std::vector<IndexRange> res;
+    for (const auto &r : ranges)
+        if (chosen.count(r.key))
+            res.push_back(r);
+
+    std::sort(res.begin(), res.end(),
+              [](const IndexRange &a, const IndexRange &b) {
+                  return a.begin < b.begin;
+              });
+    return res;
+}
+
+std::vector<IndexRange>
+assignRanges(const std::vector<IndexRange> &ranges, int rank, int size)
+{
+    std::vector<std::size_t> order(ranges.size());
+    for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+
+    // крупные диапазоны первыми — к наименее загруженному rank'у
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        uint64_t sa = ranges[a].end - ranges[a].begin;
+        uint64_t sb = ranges[b].end - ranges[b].begin;
+        if (sa != sb) return sa > sb;
+        return ranges[a].begin < ranges[b].begin;
+    });
+
+    std::vector<uint64_t> load(size, 0);
+    std::vector<IndexRange> mine;
+
+    for (std::size_t i : order) {
+        int dst = static_cast<int>(
+            std::min_element(load.begin(), load.end()) - load.begin());
+        load[dst] += ranges[i].end - ranges[i].begin;
+        if (dst == rank)
+            mine.push_back(ranges[i]);
+    }
+
+    std::sort(mine.begin(), mine.end(),
+              [](const IndexRange &a, const IndexRange &b) {
+                  return a.begin < b.begin;
+              });
+    return mine;
+}
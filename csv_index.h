@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "types.h"
+
+// Разреженный индекс по исходному CSV: файл сгруппирован по городам,
+// поэтому каждая серия — непрерывный диапазон байт.
+// Хранится рядом с CSV (<csv>.idx) и перестраивается, если CSV изменился.
+
+struct IndexRange {
+    std::string key;     // "Country|City"
+    uint64_t begin = 0;  // смещение первой строки
+    uint64_t end   = 0;  // смещение после последней строки
+    int minYear = 0;
+    int maxYear = 0;
+};
+
+struct CsvIndex {
+    uint64_t fileSize = 0;
+    int64_t  mtime    = 0;
+    std::vector<IndexRange> ranges;
+};
+
+// путь к файлу индекса для данного CSV
+std::string csvIndexPath(const std::string &csv);
+
+// Коллективная: rank 0 загружает индекс (или строит и сохраняет),
+// затем рассылает его всем rank'ам. false — CSV недоступен.
+bool loadCsvIndex(const std::string &csv, CsvIndex &index);
+
+// диапазоны, которые могут содержать строки под фильтр
+std::vector<IndexRange>
+selectRanges(const CsvIndex &index, const ScanFilter &filter);
+
+// Стратифицированная выборка: в каждой стране берётся ceil(fraction * n)
+// различных key (минимум один), порядок — по хешу key и seed;
+// в результат попадают все диапазоны выбранных key
+std::vector<IndexRange>
+sampleRanges(const std::vector<IndexRange> &ranges,
+             double fraction,
+             unsigned seed);
+
+// Раскладка диапазонов по rank'ам (жадно по размеру, детерминированно).
+// Возвращает диапазоны данного rank'а в порядке смещения в файле.
+std::vector<IndexRange>
+assignRanges(const std::vector<IndexRange> &ranges, int rank, int size);
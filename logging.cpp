@@ -10,7 +10,8 @@ void log_event(int rank,
                int size,
                const std::string &op,
                double t_start,
-               double t_end)
+               double t_end,
+               const PerfSample &start)
 {
     std::ostringstream oss;
     oss << std::fixed << std::setprecision(6);
@@ -21,7 +22,18 @@ void log_event(int rank,
         << op << ","
         << t_start << ","
         << t_end << ","
-        << (t_end - t_start) << "\n";
+        << (t_end - t_start);
+
+    if (perf_profiling_enabled()) {
+        PerfSample end = perf_sample();
+        for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+            oss << ",";
+            if (start.ok[i] && end.ok[i])
+                oss << (end.value[i] - start.value[i]);
+        }
+        oss << "," << perf_peak_rss_kb(start);
+    }
+    oss << "\n";
 
     std::string line = oss.str();
     int len = line.size();
@@ -56,3 +68,11 @@ void log_event(int rank,
         out.write(buffer.data(), buffer.size());
     }
 }
+
+std::string timeline_header()
+{
+    std::string h = "rank,host,size,operation,t_start,t_end,duration";
+    if (perf_profiling_enabled())
+        h += perf_csv_header();
+    return h + "\n";
+}
@@ -1,9 +1,16 @@
 #pragma once
 #include <string>
+#include "perf_counters.h"
 
+// start — снимок perf_sample() в начале стадии;
+// при PERF_COUNTERS=1 к строке добавляются дельты счётчиков и пиковый RSS
 void log_event(int rank,
                const std::string &host,
                int size,
                const std::string &op,
                double t0,
-               double t1);
+               double t1,
+               const PerfSample &start = PerfSample());
+
+// заголовок timeline.csv (с колонками счётчиков, если они включены)
+std::string timeline_header();
@@ -4,7 +4,11 @@
 #include "reader.h"
 #include "redistribute.h"
 #include "compute.h"
+#include "batch.h"
+#include "preview.h"
+#include "serve.h"
 #include <algorithm>   
+#include <cstdlib>
 #include "logging.h"
 
 int main(int argc, char **argv)
@@ -22,25 +26,89 @@ int main(int argc, char **argv)
 
     if (rank == 0) {
         std::ofstream out("timeline.csv");
-        out << "rank,host,size,operation,t_start,t_end,duration\n";
+        out << timeline_header();
     }
 
+    PerfSample p_prog = perf_sample();
     double t_prog = MPI_Wtime();
 
-    DataVec local = readCSVChunk("GlobalLandTemperaturesByCity.csv");
+    // ----------------- BATCH -----------------
+    // BATCH_CONFIG=<file>: одно чтение и shuffle на все конфигурации
+    if (const char* batchPath = std::getenv("BATCH_CONFIG")) {
+        auto configs = loadQueryConfigs(batchPath);
+        if (rank == 0)
+            std::cerr << "[batch] " << configs.size()
+                      << " configurations from " << batchPath << std::endl;
+
+        // без конфигураций не читаем CSV впустую
+        if (configs.empty()) {
+            if (rank == 0)
+                std::cerr << "[batch] no valid configurations, aborting"
+                          << std::endl;
+            MPI_Finalize();
+            return 1;
+        }
+
+        ScanFilter filter = scanFilterForQueries(configs);
+        DataVec local = readCSVChunk("GlobalLandTemperaturesByCity.csv", filter);
+        DataVec owned = redistributeByKey(local);
+
+        runBatch(configs, filter, owned);
+
+        log_event(rank, hostname, size,
+                  "program_total", t_prog, MPI_Wtime(), p_prog);
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    // ----------------- SERVICE -----------------
+    // SERVE_SOCKET / SERVE_COMMANDS: загрузить один раз и отвечать на запросы
+    if (serviceRequested()) {
+        ScanFilter filter = scanFilterFromEnv();
+        // сервис всегда отвечает по полным данным, выборка предпросмотра
+        // сюда не относится
+        if (filter.sampling()) {
+            if (rank == 0)
+                std::cerr << "[serve] PREVIEW_FRACTION ignored in service mode"
+                          << std::endl;
+            filter.sampleFraction = 1.0;
+        }
+        addServiceUncertCuts(filter);
+        DataVec local = readCSVChunk("GlobalLandTemperaturesByCity.csv", filter);
+        DataVec owned = redistributeByKey(local);
+        local.clear();
+        local.shrink_to_fit();
+
+        runService(filter, owned);
+
+        log_event(rank, hostname, size,
+                  "program_total", t_prog, MPI_Wtime(), p_prog);
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    // PREVIEW_FRACTION=<0..1>: выборка диапазонов вместо полного прохода
+    ScanFilter filter = scanFilterFromEnv();
+    ScanCoverage coverage;
+    DataVec local = readCSVChunk("GlobalLandTemperaturesByCity.csv",
+                                 filter, &coverage);
     DataVec owned = redistributeByKey(local);
 
     // ----------------- MIN DELTA -----------------
+    PerfSample p0 = perf_sample();
     double t0 = MPI_Wtime();
     auto localDeltas = computeLocalStats(owned);
     double t1 = MPI_Wtime();
-    log_event(rank, hostname, size, "final_compute", t0, t1);
+    log_event(rank, hostname, size, "final_compute", t0, t1, p0);
 
     // ----------------- REDUCE -----------------
+    PerfSample p2 = perf_sample();
     double t2 = MPI_Wtime();
     auto deltas = reduceMinDeltasMPI(localDeltas);
     double t3 = MPI_Wtime();
-    log_event(rank, hostname, size, "reduce_min_delta", t2, t3);
+    log_event(rank, hostname, size, "reduce_min_delta", t2, t3, p2);
 
 
     if (rank == 0) {
@@ -49,25 +117,16 @@ int main(int argc, char **argv)
     }
 
     if (rank == 0) {
-        std::ofstream out2("min_delta.txt");
-        out2 << "Country,City,MinAbsYearlyDelta\n";
-
-        int count = 0;
-        for (const auto &md : deltas) {
-            if (count >= 100) break;
-            if (md.delta <= 0.0001) continue;
-
-            auto sep = md.key.find('|');
-            out2 << md.key.substr(0, sep) << ","
-                 << md.key.substr(sep + 1) << ","
-                 << md.delta << "\n";
-            ++count;
-        }
+        if (filter.sampling())
+            writePreviewReport("min_delta_preview.txt", deltas, 0.0001, 100,
+                               filter, coverage);
+        else
+            writeMinDeltaReport("min_delta.txt", deltas, 0.0001, 100);
     }
 
     /* ВСЕ ранки логируют program_total */
     log_event(rank, hostname, size,
-              "program_total", t_prog, MPI_Wtime());
+              "program_total", t_prog, MPI_Wtime(), p_prog);
 
     MPI_Finalize();
     return 0;
@@ -0,0 +1,220 @@
+#include "perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const char* const COUNTER_NAMES[PERF_NUM_COUNTERS] = {
+    "cycles",
+    "instructions",
+    "llc_misses",
+    "branch_misses",
+    "page_faults"
+};
+
+bool perf_profiling_enabled()
+{
+    static const bool enabled = [] {
+        const char* v = std::getenv("PERF_COUNTERS");
+        return v && std::strcmp(v, "1") == 0;
+    }();
+    return enabled;
+}
+
+// ============================================================================
+// Открытие счётчиков (один раз на процесс)
+// ============================================================================
+
+static int lastOpenError = 0;
+
+static int openCounter(uint32_t type, uint64_t config)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size   = sizeof(attr);
+    attr.type   = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;   // работает при perf_event_paranoid <= 2
+    attr.exclude_hv     = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0) lastOpenError = errno;
+    return static_cast<int>(fd);
+}
+
+static const int* counterFds()
+{
+    static int fds[PERF_NUM_COUNTERS];
+    static bool opened = false;
+
+    if (opened) return fds;
+    opened = true;
+
+    fds[PERF_CYCLES] =
+        openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fds[PERF_INSTRUCTIONS] =
+        openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fds[PERF_LLC_MISSES] =
+        openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    fds[PERF_BRANCH_MISSES] =
+        openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    fds[PERF_PAGE_FAULTS] =
+        openCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+
+    int missing = 0;
+    for (int i = 0; i < PERF_NUM_COUNTERS; ++i)
+        if (fds[i] < 0) ++missing;
+
+    if (missing) {
+        std::cerr << "[perf] " << missing << " of " << PERF_NUM_COUNTERS
+                  << " counters unavailable ("
+                  << std::strerror(lastOpenError) << ")"
+                  << (missing == PERF_NUM_COUNTERS
+                        ? ", timings and RSS only" : "")
+                  << std::endl;
+    }
+    return fds;
+}
+
+// ============================================================================
+// Снимки
+// ============================================================================
+
+// ============================================================================
+// Пиковый RSS по стадиям
+//   Ядро хранит один high-water mark (VmHWM), "5" в clear_refs сбрасывает
+//   его до текущего RSS. Стадии вложены, поэтому каждый снимок закрывает
+//   отрезок (запоминая его пик) и открывает новый; пик стадии — максимум
+//   по отрезкам от её начального снимка.
+// ============================================================================
+
+static long statusKb(const char* field)
+{
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    std::size_t n = std::strlen(field);
+    while (std::getline(in, line))
+        if (line.compare(0, n, field) == 0)
+            return std::atol(line.c_str() + n);
+    return -1;
+}
+
+static bool resetHwm()
+{
+    std::ofstream out("/proc/self/clear_refs");
+    out << "5";
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+static bool hwmResettable()
+{
+    static const bool ok = [] {
+        bool r = statusKb("VmHWM:") >= 0 && resetHwm();
+        if (!r)
+            std::cerr << "[perf] cannot reset VmHWM, peak_rss_kb is "
+                         "process-wide (ru_maxrss)" << std::endl;
+        return r;
+    }();
+    return ok;
+}
+
+static std::vector<long> rssEpochPeak;   // KiB
+
+static void closeRssEpoch()
+{
+    long h = statusKb("VmHWM:");
+    if (rssEpochPeak.empty())
+        rssEpochPeak.push_back(h);
+    else if (h > rssEpochPeak.back())
+        rssEpochPeak.back() = h;
+}
+
+static long openRssEpoch()
+{
+    closeRssEpoch();
+    if (!resetHwm())
+        return -1;
+    rssEpochPeak.push_back(statusKb("VmRSS:"));
+    return static_cast<long>(rssEpochPeak.size()) - 1;
+}
+
+PerfSample perf_sample()
+{
+    PerfSample s;
+    if (!perf_profiling_enabled())
+        return s;
+
+    if (hwmResettable())
+        s.rssEpoch = openRssEpoch();
+
+    const int* fds = counterFds();
+
+    for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+        if (fds[i] < 0) continue;
+
+        // value, time_enabled, time_running
+        uint64_t buf[3];
+        if (read(fds[i], buf, sizeof(buf)) != sizeof(buf))
+            continue;
+
+        // масштабируем при мультиплексировании PMU
+        double v = static_cast<double>(buf[0]);
+        if (buf[2] > 0 && buf[2] < buf[1])
+            v = v * buf[1] / buf[2];
+
+        s.value[i] = static_cast<uint64_t>(v);
+        s.ok[i]    = true;
+    }
+
+    // page faults без perf — из getrusage
+    if (!s.ok[PERF_PAGE_FAULTS]) {
+        rusage ru;
+        if (getrusage(RUSAGE_SELF, &ru) == 0) {
+            s.value[PERF_PAGE_FAULTS] =
+                static_cast<uint64_t>(ru.ru_minflt + ru.ru_majflt);
+            s.ok[PERF_PAGE_FAULTS] = true;
+        }
+    }
+
+    return s;
+}
+
+long perf_peak_rss_kb(const PerfSample &start)
+{
+    if (start.rssEpoch >= 0 &&
+        start.rssEpoch < static_cast<long>(rssEpochPeak.size())) {
+        closeRssEpoch();
+        long peak = -1;
+        for (std::size_t i = start.rssEpoch; i < rssEpochPeak.size(); ++i)
+            peak = std::max(peak, rssEpochPeak[i]);
+        return peak;
+    }
+
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return -1;
+    return ru.ru_maxrss;   // Linux: KiB
+}
+
+std::string perf_csv_header()
+{
+    std::string h;
+    for (int i = 0; i < PERF_NUM_COUNTERS; ++i) {
+        h += ",";
+        h += COUNTER_NAMES[i];
+    }
+    h += ",peak_rss_kb";
+    return h;
+}
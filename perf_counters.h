@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Аппаратные счётчики (perf_event_open) вокруг стадий timeline.
+// Включаются PERF_COUNTERS=1; если счётчик не открылся —
+// соответствующая колонка остаётся пустой.
+
+enum PerfCounter {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_PAGE_FAULTS,
+    PERF_NUM_COUNTERS
+};
+
+struct PerfSample {
+    uint64_t value[PERF_NUM_COUNTERS] = {};
+    bool     ok[PERF_NUM_COUNTERS]    = {};
+    long     rssEpoch = -1;   // отрезок пикового RSS, начатый этим снимком
+};
+
+// включён ли режим профилирования
+bool perf_profiling_enabled();
+
+// снимок счётчиков (при выключенном режиме — пустой);
+// заодно сбрасывает пик RSS ядра, чтобы мерить его по стадиям
+PerfSample perf_sample();
+
+// пиковый RSS с момента снимка start, KiB: VmHWM со сбросом через
+// /proc/self/clear_refs; если сброс недоступен — ru_maxrss,
+// то есть максимум процесса с его старта
+long perf_peak_rss_kb(const PerfSample &start);
+
+// имена колонок для заголовка timeline.csv
+std::string perf_csv_header();
@@ -0,0 +1,68 @@
+#include "preview.h"
+#include "reduce.h"
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+static double percent(uint64_t part, uint64_t whole)
+{
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+void writePreviewReport(const std::string &path,
+                        const std::vector<MinDelta> &deltas,
+                        double threshold,
+                        int top,
+                        const ScanFilter &filter,
+                        const ScanCoverage &coverage)
+{
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(1);
+
+    if (coverage.indexed) {
+        summary << "series " << coverage.seriesRead << "/" << coverage.series
+                << " (" << percent(coverage.seriesRead, coverage.series)
+                << "%), ranges " << coverage.rangesRead << "/"
+                << coverage.ranges
+                << ", bytes " << coverage.bytesRead << "/" << coverage.bytes
+                << " (" << percent(coverage.bytesRead, coverage.bytes)
+                << "%)";
+    } else {
+        summary << "index unavailable, full scan";
+    }
+
+    std::cerr << "[preview] fraction=" << filter.sampleFraction
+              << " seen: " << summary.str() << std::endl;
+
+    std::ofstream out(path);
+    out << "# preview fraction=" << filter.sampleFraction
+        << " seed=" << filter.sampleSeed << "\n"
+        << "# seen: " << summary.str() << "\n";
+
+    out << std::fixed << std::setprecision(1);
+    for (const auto &[country, c] : coverage.countries)
+        out << "# country " << country << ": series " << c.second
+            << "/" << c.first << " (" << percent(c.second, c.first)
+            << "%)\n";
+    out.unsetf(std::ios::floatfield);
+    out << std::setprecision(6);
+
+    // Выборка — подмножество серий, каждая прочитана целиком:
+    // значения точные, а недостающие серии могут только встать выше.
+    std::size_t unseen = coverage.indexed
+        ? coverage.series - coverage.seriesRead : 0;
+
+    if (unseen == 0) {
+        out << "# all selected series read, ranking exact\n";
+    } else {
+        out << "# values exact (sampled series read whole); "
+               "row k value >= true k-th smallest over all "
+            << coverage.series << " series\n"
+            << "# true rank of row k is in [k, k+" << unseen
+            << "] (" << unseen << " series unseen)\n";
+    }
+
+    writeMinDeltaReport(out, deltas, threshold, top);
+}
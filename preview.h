@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "types.h"
+#include "reader.h"
+
+// rank 0: отчёт предпросмотра — как min_delta.txt, плюс строки '#'
+// с долей просмотренных данных (всего и по странам) и границей:
+// k-е значение выборки — верхняя граница истинного k-го минимума
+void writePreviewReport(const std::string &path,
+                        const std::vector<MinDelta> &deltas,
+                        double threshold,
+                        int top,
+                        const ScanFilter &filter,
+                        const ScanCoverage &coverage);
@@ -0,0 +1,273 @@
+#include "query.h"
+#include "reduce.h"
+#include "reader.h"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cerrno>
+#include <cstring>
+
+// ============================================================================
+// Разбор конфигураций
+// ============================================================================
+
+bool parseQueryConfig(const std::string &line,
+                      QueryConfig &q,
+                      std::string &err)
+{
+    std::istringstream in(line);
+    std::string tok;
+
+    if (!(in >> q.name)) {
+        err = "missing name";
+        return false;
+    }
+
+    while (in >> tok) {
+        auto eq = tok.find('=');
+        if (eq == std::string::npos) {
+            err = "expected key=value, got '" + tok + "'";
+            return false;
+        }
+        std::string k = tok.substr(0, eq);
+        std::string v = tok.substr(eq + 1);
+
+        try {
+            if      (k == "uncert")    q.uncertMax = std::stod(v);
+            else if (k == "from")      q.yearFrom  = std::stoi(v);
+            else if (k == "to")        q.yearTo    = std::stoi(v);
+            else if (k == "country")   q.countries = splitList(v.c_str());
+            else if (k == "threshold") q.threshold = std::stod(v);
+            else if (k == "top")       q.top       = std::stoi(v);
+            else if (k == "stat") {
+                if (v != "min_delta" && v != "max_delta" && v != "mean") {
+                    err = "unknown stat '" + v + "'";
+                    return false;
+                }
+                q.stat = v;
+            }
+            else {
+                err = "unknown key '" + k + "'";
+                return false;
+            }
+        } catch (...) {
+            err = "bad value for '" + k + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<QueryConfig> loadQueryConfigs(const std::string &path)
+{
+    std::vector<QueryConfig> res;
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << path << ": cannot open: " << std::strerror(errno) << "\n";
+        return res;
+    }
+
+    std::string line;
+    int line_no = 0;
+
+    while (std::getline(in, line)) {
+        ++line_no;
+        auto hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        QueryConfig q;
+        std::string err;
+        bool ok = parseQueryConfig(line, q, err);
+
+        // имя становится частью имени файла отчёта (min_delta_<name>.txt)
+        if (ok && q.name.find('/') != std::string::npos) {
+            err = "name '" + q.name + "' contains '/'";
+            ok = false;
+        }
+        if (ok && std::any_of(res.begin(), res.end(),
+                              [&](const QueryConfig &o) {
+                                  return o.name == q.name;
+                              })) {
+            err = "duplicate name '" + q.name + "'";
+            ok = false;
+        }
+
+        if (ok)
+            res.push_back(q);
+        else
+            std::cerr << path << ":" << line_no << ": " << err
+                      << ", skipped\n";
+    }
+    return res;
+}
+
+ScanFilter scanFilterForQueries(const std::vector<QueryConfig> &qs)
+{
+    ScanFilter f;
+    if (qs.empty()) return f;
+
+    f.uncertCuts.clear();
+    f.yearFrom = INT_MAX;
+    f.yearTo   = INT_MIN;
+    bool allCountries = true;
+
+    for (const auto &q : qs) {
+        f.uncertCuts.push_back(q.uncertMax);
+        f.yearFrom = std::min(f.yearFrom, q.yearFrom);
+        f.yearTo   = std::max(f.yearTo,   q.yearTo);
+
+        if (q.countries.empty())
+            allCountries = false;
+        else
+            f.countries.insert(f.countries.end(),
+                               q.countries.begin(), q.countries.end());
+    }
+
+    std::sort(f.uncertCuts.begin(), f.uncertCuts.end());
+    f.uncertCuts.erase(std::unique(f.uncertCuts.begin(), f.uncertCuts.end()),
+                       f.uncertCuts.end());
+
+    if (allCountries) {
+        std::sort(f.countries.begin(), f.countries.end());
+        f.countries.erase(std::unique(f.countries.begin(), f.countries.end()),
+                          f.countries.end());
+    } else {
+        f.countries.clear();
+    }
+    return f;
+}
+
+// ============================================================================
+// Агрегаты и оценка
+// ============================================================================
+
+BucketedAggregates
+aggregateByBucket(const DataVec &data, std::size_t buckets)
+{
+    BucketedAggregates agg;
+    for (const auto &r : data) {
+        auto &cell = agg[r.key][r.year];
+        if (cell.empty()) cell.resize(buckets);
+        Stat &s = cell[r.bucket];
+        s.sum   += r.temp;
+        s.count += 1;
+    }
+    return agg;
+}
+
+bool queryDescending(const QueryConfig &q)
+{
+    return q.stat != "min_delta";
+}
+
+std::string queryValueColumn(const QueryConfig &q)
+{
+    if (q.stat == "max_delta") return "MaxAbsYearlyDelta";
+    if (q.stat == "mean")      return "MeanTemperature";
+    return "MinAbsYearlyDelta";
+}
+
+std::vector<MinDelta>
+evaluateQuery(const BucketedAggregates &agg,
+              const ScanFilter &scan,
+              const QueryConfig &q)
+{
+    // корзины 0..last покрывают uncert <= q.uncertMax
+    const auto &cuts = scan.uncertCuts;
+    std::size_t last =
+        std::lower_bound(cuts.begin(), cuts.end(), q.uncertMax) - cuts.begin();
+
+    const bool isMean = q.stat == "mean";
+    const bool isMax  = q.stat == "max_delta";
+
+    std::vector<MinDelta> res;
+
+    for (const auto &[key, years] : agg) {
+        if (!q.countries.empty()) {
+            std::string country = key.substr(0, key.find('|'));
+            if (std::find(q.countries.begin(), q.countries.end(), country)
+                    == q.countries.end())
+                continue;
+        }
+
+        double best = isMax ? -1.0 : std::numeric_limits<double>::max();
+        double prev = 0.0;
+        bool havePrev = false;
+
+        double total = 0.0;
+        long   totalCnt = 0;
+
+        for (auto it = years.lower_bound(q.yearFrom);
+             it != years.end() && it->first <= q.yearTo; ++it) {
+            double sum = 0.0;
+            int    cnt = 0;
+            for (std::size_t b = 0; b <= last && b < it->second.size(); ++b) {
+                sum += it->second[b].sum;
+                cnt += it->second[b].count;
+            }
+            if (cnt == 0) continue;
+
+            total    += sum;
+            totalCnt += cnt;
+
+            double cur = sum / cnt;
+            if (havePrev) {
+                double d = std::abs(cur - prev);
+                best = isMax ? std::max(best, d) : std::min(best, d);
+            }
+            prev = cur;
+            havePrev = true;
+        }
+
+        if (isMean) {
+            if (totalCnt > 0)
+                res.push_back({ key, total / totalCnt });
+        } else if (best >= 0.0 &&
+                   best != std::numeric_limits<double>::max() &&
+                   best > q.threshold) {
+            res.push_back({ key, best });
+        }
+    }
+
+    // глобальный top-K — подмножество объединения локальных top-K
+    bool desc = queryDescending(q);
+    auto byValue = [desc](const MinDelta &a, const MinDelta &b) {
+        if (a.delta != b.delta)
+            return desc ? a.delta > b.delta : a.delta < b.delta;
+        return a.key < b.key;
+    };
+    if (q.top >= 0 && res.size() > static_cast<std::size_t>(q.top)) {
+        std::partial_sort(res.begin(), res.begin() + q.top, res.end(), byValue);
+        res.resize(q.top);
+    }
+    return res;
+}
+
+std::vector<MinDelta>
+runQueryMPI(const BucketedAggregates &agg,
+            const ScanFilter &scan,
+            const QueryConfig &q)
+{
+    auto local = evaluateQuery(agg, scan, q);
+
+    // reduce сортирует по возрастанию — для убывающих статистик меняем знак
+    bool desc = queryDescending(q);
+    if (desc)
+        for (auto &md : local) md.delta = -md.delta;
+
+    auto global = reduceMinDeltasMPI(local);
+
+    if (desc)
+        for (auto &md : global) md.delta = -md.delta;
+
+    if (q.top >= 0 && global.size() > static_cast<std::size_t>(q.top))
+        global.resize(q.top);
+
+    return global;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <climits>
+#include <unordered_map>
+#include <map>
+#include "types.h"
+
+// Одна конфигурация анализа (строка batch-файла или запрос сервиса):
+//   <name> [stat=min_delta|max_delta|mean] [uncert=3.0] [from=Y] [to=Y]
+//          [country=A;B] [threshold=0.0001] [top=100]
+// threshold относится только к delta-статистикам; top < 0 — без ограничения
+struct QueryConfig {
+    std::string name;
+    std::string stat = "min_delta";
+    double uncertMax = 3.0;
+    int    yearFrom  = INT_MIN;
+    int    yearTo    = INT_MAX;
+    std::vector<std::string> countries;
+    double threshold = 0.0001;
+    int    top       = 100;
+};
+
+// разбор строки; false + err при ошибке
+bool parseQueryConfig(const std::string &line,
+                      QueryConfig &q,
+                      std::string &err);
+
+// файл конфигураций: по одной на строку, '#' — комментарий;
+// строки с ошибкой, '/' в имени или повтором имени пропускаются,
+// неоткрывающийся файл — пустой результат (с сообщением)
+std::vector<QueryConfig> loadQueryConfigs(const std::string &path);
+
+// Общий фильтр чтения для набора конфигураций:
+// пороги неопределённости — все различные uncert,
+// окно лет и страны — объединение (если ограничены у всех)
+ScanFilter scanFilterForQueries(const std::vector<QueryConfig> &qs);
+
+// key → year → Stat по каждой корзине неопределённости
+using BucketedAggregates =
+    std::unordered_map<std::string,
+        std::map<int, std::vector<Stat>>>;
+
+BucketedAggregates
+aggregateByBucket(const DataVec &data, std::size_t buckets);
+
+// по убыванию ли ранжируется статистика (всё, кроме min_delta)
+bool queryDescending(const QueryConfig &q);
+
+// имя колонки значения в отчёте
+std::string queryValueColumn(const QueryConfig &q);
+
+// Локальная оценка: только ключи этого rank'а,
+// уже отфильтрованные по threshold и урезанные до top
+std::vector<MinDelta>
+evaluateQuery(const BucketedAggregates &agg,
+              const ScanFilter &scan,
+              const QueryConfig &q);
+
+// Коллективная: оценка + reduce; итоговый top на rank 0
+std::vector<MinDelta>
+runQueryMPI(const BucketedAggregates &agg,
+            const ScanFilter &scan,
+            const QueryConfig &q);
@@ -1,4 +1,5 @@
 #include "reader.h"
+#include "csv_index.h"
 #include "logging.h"
 
 #include <mpi.h>
@@ -6,20 +7,113 @@
 #include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_set>
 
-DataVec readCSVChunk(const std::string &filename)
+// ============================================================================
+// Разбор одной строки CSV
+// ============================================================================
+
+static bool parseLine(const std::string &line,
+                      const ScanFilter &filter,
+                      Record &r)
 {
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    std::stringstream ss(line);
+    std::string dt, tempStr, uncertStr, city, country;
 
-    char host[MPI_MAX_PROCESSOR_NAME];
-    int hostlen;
-    MPI_Get_processor_name(host, &hostlen);
-    std::string hostname(host);
+    std::getline(ss, dt, ',');
+    std::getline(ss, tempStr, ',');
+    std::getline(ss, uncertStr, ',');
+    std::getline(ss, city, ',');
+    std::getline(ss, country, ',');
 
-    double t0 = MPI_Wtime();
+    if (dt.size() < 4 || city.empty() || country.empty())
+        return false;
 
+    double uncert;
+    try { uncert = std::stod(uncertStr); }
+    catch (...) { return false; }
+
+    const auto &cuts = filter.uncertCuts;
+    auto cut = std::lower_bound(cuts.begin(), cuts.end(), uncert);
+    if (cut == cuts.end()) return false;
+
+    double temp;
+    try { temp = std::stod(tempStr); }
+    catch (...) { return false; }
+
+    int year = std::stoi(dt.substr(0,4));
+
+    r.key  = country + "|" + city;
+    r.year = year;
+    r.temp = temp;
+    r.bucket = static_cast<int>(cut - cuts.begin());
+    return true;
+}
+
+// ============================================================================
+// Фильтр из окружения: FILTER_COUNTRY, FILTER_CITY (списки через ';'),
+// YEAR_FROM, YEAR_TO
+// ============================================================================
+
+std::vector<std::string> splitList(const char* v)
+{
+    std::vector<std::string> out;
+    if (!v) return out;
+
+    std::stringstream ss(v);
+    std::string item;
+    while (std::getline(ss, item, ';'))
+        if (!item.empty())
+            out.push_back(item);
+    return out;
+}
+
+ScanFilter scanFilterFromEnv()
+{
+    ScanFilter f;
+    f.countries = splitList(std::getenv("FILTER_COUNTRY"));
+    f.cities    = splitList(std::getenv("FILTER_CITY"));
+
+    if (const char* y = std::getenv("YEAR_FROM")) f.yearFrom = std::atoi(y);
+    if (const char* y = std::getenv("YEAR_TO"))   f.yearTo   = std::atoi(y);
+
+    if (const char* p = std::getenv("PREVIEW_FRACTION")) {
+        double frac = std::atof(p);
+        if (frac > 0.0 && frac < 1.0) f.sampleFraction = frac;
+    }
+    if (const char* p = std::getenv("PREVIEW_SEED"))
+        f.sampleSeed = static_cast<unsigned>(std::strtoul(p, nullptr, 10));
+
+    return f;
+}
+
+static bool inList(const std::vector<std::string> &v, const std::string &s)
+{
+    return v.empty() || std::find(v.begin(), v.end(), s) != v.end();
+}
+
+static bool matches(const ScanFilter &f, const Record &r)
+{
+    if (r.year < f.yearFrom || r.year > f.yearTo)
+        return false;
+    if (f.countries.empty() && f.cities.empty())
+        return true;
+
+    auto sep = r.key.find('|');
+    return inList(f.countries, r.key.substr(0, sep)) &&
+           inList(f.cities,    r.key.substr(sep + 1));
+}
+
+// ============================================================================
+// Полный проход: строки раздаются по rank'ам через одну
+// ============================================================================
+
+static DataVec readAllLines(const std::string &filename,
+                            const ScanFilter &filter,
+                            int rank, int size)
+{
     DataVec result;
     std::ifstream file(filename);
     if (!file) return result;
@@ -36,40 +130,118 @@ DataVec readCSVChunk(const std::string &filename)
         }
         ++line_no;
 
-        std::stringstream ss(line);
-        std::string dt, tempStr, uncertStr, city, country;
+        Record r;
+        if (parseLine(line, filter, r) && matches(filter, r))
+            result.push_back(r);
+    }
+
+    return result;
+}
 
-        std::getline(ss, dt, ',');
-        std::getline(ss, tempStr, ',');
-        std::getline(ss, uncertStr, ',');
-        std::getline(ss, city, ',');
-        std::getline(ss, country, ',');
+// ============================================================================
+// Чтение по индексу: только диапазоны, подходящие под фильтр
+// ============================================================================
 
-        if (dt.size() < 4 || city.empty() || country.empty())
-            continue;
+static void fillCoverage(const std::vector<IndexRange> &selected,
+                         const std::vector<IndexRange> &read,
+                         ScanCoverage &cov)
+{
+    std::unordered_set<std::string> total, seen;
+
+    cov.indexed = true;
+    cov.ranges  = selected.size();
+    cov.rangesRead = read.size();
+
+    for (const auto &r : selected) {
+        cov.bytes += r.end - r.begin;
+        total.insert(r.key);
+    }
+    for (const auto &r : read) {
+        cov.bytesRead += r.end - r.begin;
+        seen.insert(r.key);
+    }
 
-        double uncert;
-        try { uncert = std::stod(uncertStr); }
-        catch (...) { continue; }
+    cov.series     = total.size();
+    cov.seriesRead = seen.size();
 
-        if (uncert > 3.0) continue;
+    for (const auto &key : total)
+        ++cov.countries[key.substr(0, key.find('|'))].first;
+    for (const auto &key : seen)
+        ++cov.countries[key.substr(0, key.find('|'))].second;
+}
 
-        double temp;
-        try { temp = std::stod(tempStr); }
-        catch (...) { continue; }
+static DataVec readIndexedRanges(const std::string &filename,
+                                 const ScanFilter &filter,
+                                 const CsvIndex &index,
+                                 int rank, int size,
+                                 ScanCoverage *coverage)
+{
+    auto selected = selectRanges(index, filter);
+    auto toRead   = filter.sampling()
+        ? sampleRanges(selected, filter.sampleFraction, filter.sampleSeed)
+        : selected;
+    auto mine     = assignRanges(toRead, rank, size);
 
-        int year = std::stoi(dt.substr(0,4));
+    if (coverage)
+        fillCoverage(selected, toRead, *coverage);
 
-        Record r;
-        r.key  = country + "|" + city;
-        r.year = year;
-        r.temp = temp;
+    DataVec result;
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) return result;
 
-        result.push_back(r);
+    std::string buf, line;
+    uint64_t bytes = 0;
+
+    for (const auto &range : mine) {
+        buf.resize(range.end - range.begin);
+        file.seekg(static_cast<std::streamoff>(range.begin));
+        file.read(&buf[0], static_cast<std::streamsize>(buf.size()));
+        buf.resize(static_cast<std::size_t>(file.gcount()));
+        bytes += buf.size();
+
+        std::istringstream in(buf);
+        while (std::getline(in, line)) {
+            Record r;
+            if (parseLine(line, filter, r) && matches(filter, r))
+                result.push_back(r);
+        }
     }
 
+    std::cerr << "[rank " << rank << "] index: ranges=" << mine.size()
+              << "/" << toRead.size()
+              << " bytes=" << bytes << std::endl;
+
+    return result;
+}
+
+DataVec readCSVChunk(const std::string &filename,
+                     const ScanFilter &filter,
+                     ScanCoverage *coverage)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    char host[MPI_MAX_PROCESSOR_NAME];
+    int hostlen;
+    MPI_Get_processor_name(host, &hostlen);
+    std::string hostname(host);
+
+    PerfSample p0 = perf_sample();
+    double t0 = MPI_Wtime();
+
+    DataVec result;
+    CsvIndex index;
+
+    if ((filter.active() || filter.sampling()) &&
+        loadCsvIndex(filename, index))
+        result = readIndexedRanges(filename, filter, index,
+                                   rank, size, coverage);
+    else
+        result = readAllLines(filename, filter, rank, size);
+
     double t1 = MPI_Wtime();
-    log_event(rank, hostname, size, "read+filter", t0, t1);
+    log_event(rank, hostname, size, "read+filter", t0, t1, p0);
 
     return result;
 }
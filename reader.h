@@ -1,5 +1,27 @@
 #pragma once
 #include <string>
+#include <cstdint>
+#include <map>
 #include "types.h"
 
-DataVec readCSVChunk(const std::string &filename);
+// фильтр из FILTER_COUNTRY / FILTER_CITY / YEAR_FROM / YEAR_TO
+// и PREVIEW_FRACTION / PREVIEW_SEED
+ScanFilter scanFilterFromEnv();
+
+// список через ';' (пустые элементы пропускаются); nullptr — пустой
+std::vector<std::string> splitList(const char* v);
+
+// Сколько данных реально прочитано (одинаково на всех rank'ах)
+struct ScanCoverage {
+    bool        indexed = false;
+    uint64_t    ranges = 0, rangesRead = 0;   // под предикатами / прочитано
+    uint64_t    bytes  = 0, bytesRead  = 0;
+    std::size_t series = 0, seriesRead = 0;
+    // страна → {series, seriesRead}
+    std::map<std::string, std::pair<std::size_t, std::size_t>> countries;
+};
+
+// при активном фильтре или выборке читает только нужные диапазоны по индексу
+DataVec readCSVChunk(const std::string &filename,
+                     const ScanFilter &filter = ScanFilter(),
+                     ScanCoverage *coverage = nullptr);
@@ -1,4 +1,5 @@
 #include "redistribute.h"
+#include "shuffle_codec.h"
 #include "logging.h"
 
 #include <mpi.h>
@@ -12,9 +13,9 @@
 #include <iostream>
 #include <cstdint>
 
-static uint64_t stableHash(const std::string &s)
+uint64_t stableHash(const std::string &s, uint64_t seed)
 {
-    uint64_t h = 1469598103934665603ull; // FNV-1a
+    uint64_t h = 1469598103934665603ull ^ seed; // FNV-1a
     for (unsigned char c : s) {
         h ^= c;
         h *= 1099511628211ull;
@@ -66,6 +67,119 @@ static int ownerRankWeighted(
 }
 
 
+// ============================================================================
+// Сжатие буферов: SHUFFLE_COMPRESS=0 | 1 | auto (по умолчанию)
+// ============================================================================
+
+enum class CompressMode { Off, On, Auto };
+
+static CompressMode getCompressMode()
+{
+    const char* v = std::getenv("SHUFFLE_COMPRESS");
+    if (!v) return CompressMode::Auto;
+    if (std::strcmp(v, "0") == 0 || std::strcmp(v, "off") == 0)
+        return CompressMode::Off;
+    if (std::strcmp(v, "1") == 0 || std::strcmp(v, "on") == 0)
+        return CompressMode::On;
+    return CompressMode::Auto;
+}
+
+// пропускная способность Alltoall (байт/с, лучшая из нескольких попыток)
+static double measureLinkBandwidth(int size)
+{
+    const int PROBE = 256 * 1024;   // на каждого адресата
+    const int REPS  = 3;
+
+    std::vector<char> sendProbe(static_cast<std::size_t>(PROBE) * size, 0);
+    std::vector<char> recvProbe(sendProbe.size());
+
+    double best = 0.0;
+    for (int r = 0; r < REPS; ++r) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        MPI_Alltoall(sendProbe.data(), PROBE, MPI_CHAR,
+                     recvProbe.data(), PROBE, MPI_CHAR,
+                     MPI_COMM_WORLD);
+        double dt = MPI_Wtime() - t0;
+        if (dt > 0.0)
+            best = std::max(best, double(PROBE) * (size - 1) / dt);
+    }
+    return best;
+}
+
+// Оценка по выборке: текст (format + send + parse) против
+// кодека (encode + send + decode). Решение общее для всех rank'ов.
+static bool shouldCompress(const DataVec &local, int rank, int size)
+{
+    if (size < 2) return false;
+
+    double bw = measureLinkBandwidth(size);
+
+    const std::size_t SAMPLE = 20000;
+    std::size_t n = std::min(local.size(), SAMPLE);
+    double scale = n ? double(local.size()) / n : 0.0;
+
+    double plainCost = 0.0, compCost = 0.0;
+
+    if (n > 0) {
+        double t0 = MPI_Wtime();
+        std::ostringstream oss;
+        for (std::size_t i = 0; i < n; ++i)
+            oss << local[i].key << ';' << local[i].year << ';'
+                << local[i].temp << '\n';
+        std::string text = oss.str();
+        double t1 = MPI_Wtime();
+
+        std::istringstream in(text);
+        std::string line;
+        DataVec parsed;
+        while (std::getline(in, line)) {
+            std::stringstream ss(line);
+            Record r;
+            std::string year, temp;
+            std::getline(ss, r.key, ';');
+            std::getline(ss, year,  ';');
+            std::getline(ss, temp,  ';');
+            r.year = std::stoi(year);
+            r.temp = std::stod(temp);
+            parsed.push_back(r);
+        }
+        double t2 = MPI_Wtime();
+
+        std::vector<const Record*> ptrs(n);
+        for (std::size_t i = 0; i < n; ++i) ptrs[i] = &local[i];
+
+        CodecStats st;
+        std::string frame;
+        encodeShuffleFrame(ptrs.data(), ptrs.data() + n, frame, st);
+        double t3 = MPI_Wtime();
+
+        DataVec decoded;
+        decodeShuffleFrame(frame.data(), frame.size(), decoded);
+        double t4 = MPI_Wtime();
+
+        double link = bw > 0.0 ? bw : 1e12;
+        plainCost = scale * ((t1 - t0) + (t2 - t1) + text.size() / link);
+        compCost  = scale * ((t3 - t2) + (t4 - t3) + frame.size() / link);
+    }
+
+    double costs[2] = { plainCost, compCost };
+    double worst[2];
+    MPI_Allreduce(costs, worst, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    bool on = worst[1] < worst[0];
+
+    if (rank == 0) {
+        std::cerr << "[shuffle] link=" << bw / 1e6 << " MB/s"
+                  << " est_plain=" << worst[0] << "s"
+                  << " est_compressed=" << worst[1] << "s"
+                  << " -> compression " << (on ? "on" : "off")
+                  << std::endl;
+    }
+    return on;
+}
+
+
 // ============================================================================
 // Основная функция redistribute
 // ============================================================================
@@ -81,6 +195,7 @@ DataVec redistributeByKey(const DataVec &local)
     MPI_Get_processor_name(host, &hostlen);
     std::string hostname(host);
 
+    PerfSample p0 = perf_sample();
     double t0 = MPI_Wtime();
 
     // ------------------------------------------------------------------------
@@ -105,29 +220,61 @@ DataVec redistributeByKey(const DataVec &local)
     int totalWeight = prefix[size];
 
     // ------------------------------------------------------------------------
-    // 2. Формируем send buffers
+    // 2. Формируем send buffers (текст или сжатые кадры)
     // ------------------------------------------------------------------------
 
-    std::vector<std::ostringstream> sendBuf(size);
+    CompressMode mode = getCompressMode();
+    bool compress =
+        mode == CompressMode::On ||
+        (mode == CompressMode::Auto && shouldCompress(local, rank, size));
 
-    for (const auto &r : local) {
-        int dst = ownerRankWeighted(r.key, prefix, totalWeight);
-        sendBuf[dst] << r.key << ';'
-                     << r.year << ';'
-                     << r.temp << '\n';
+    std::vector<std::string> sendStr(size);
+    CodecStats codec;
+    double encodeTime = 0.0;
+
+    if (compress) {
+        PerfSample pe0 = perf_sample();
+        double te0 = MPI_Wtime();
+
+        std::vector<std::vector<const Record*>> perDst(size);
+        for (const auto &r : local)
+            perDst[ownerRankWeighted(r.key, prefix, totalWeight)]
+                .push_back(&r);
+
+        for (int i = 0; i < size; ++i)
+            encodeShuffleFrame(perDst[i].data(),
+                               perDst[i].data() + perDst[i].size(),
+                               sendStr[i], codec);
+
+        encodeTime = MPI_Wtime() - te0;
+        log_event(rank, hostname, size, "shuffle_encode",
+                  te0, te0 + encodeTime, pe0);
+    } else {
+        std::vector<std::ostringstream> sendBuf(size);
+
+        for (const auto &r : local) {
+            int dst = ownerRankWeighted(r.key, prefix, totalWeight);
+            sendBuf[dst] << r.key << ';'
+                         << r.year << ';'
+                         << r.temp;
+            // корзина неопределённости нужна только batch-режиму
+            if (r.bucket != 0)
+                sendBuf[dst] << ';' << r.bucket;
+            sendBuf[dst] << '\n';
+        }
+
+        for (int i = 0; i < size; ++i)
+            sendStr[i] = sendBuf[i].str();
     }
 
     // ------------------------------------------------------------------------
     // 3. Размеры сообщений
     // ------------------------------------------------------------------------
 
-    std::vector<std::string> sendStr(size);
     std::vector<int> sendSizes(size);
 
-    for (int i = 0; i < size; ++i) {
-        sendStr[i]   = sendBuf[i].str();
+    for (int i = 0; i < size; ++i)
         sendSizes[i] = static_cast<int>(sendStr[i].size());
-    }
 
     std::vector<int> recvSizes(size);
     MPI_Alltoall(
@@ -178,6 +325,36 @@ DataVec redistributeByKey(const DataVec &local)
     DataVec result;
     result.reserve(local.size()); // эвристика
 
+    if (compress) {
+        PerfSample pd0 = perf_sample();
+        double td0 = MPI_Wtime();
+
+        for (int i = 0; i < size; ++i)
+            decodeShuffleFrame(recvBufFlat.data() + rdispls[i],
+                               recvSizes[i], result);
+
+        double td1 = MPI_Wtime();
+        log_event(rank, hostname, size, "shuffle_decode", td0, td1, pd0);
+
+        std::cerr
+            << "[rank " << rank << " | " << hostname << "] "
+            << "shuffle records=" << codec.records
+            << " series=" << codec.series
+            << " full=" << codec.fullBytes
+            << " packed=" << codec.packedBytes
+            << " wire=" << codec.wireBytes
+            << " ratio=" << (codec.wireBytes
+                    ? double(codec.fullBytes) / codec.wireBytes : 0.0)
+            << " encode=" << encodeTime << "s"
+            << " decode=" << (td1 - td0) << "s"
+            << std::endl;
+
+        double t1 = MPI_Wtime();
+        log_event(rank, hostname, size, "redistribute", t0, t1, p0);
+
+        return result;
+    }
+
     std::string all(recvBufFlat.begin(), recvBufFlat.end());
     std::istringstream in(all);
     std::string line;
@@ -187,20 +364,23 @@ DataVec redistributeByKey(const DataVec &local)
 
         std::stringstream ss(line);
         Record r;
-        std::string year, temp;
+        std::string year, temp, bucket;
 
         std::getline(ss, r.key, ';');
         std::getline(ss, year,  ';');
         std::getline(ss, temp,  ';');
+        std::getline(ss, bucket, ';');
 
         r.year = std::stoi(year);
         r.temp = std::stod(temp);
+        if (!bucket.empty())
+            r.bucket = std::stoi(bucket);
 
         result.push_back(r);
     }
 
     double t1 = MPI_Wtime();
-    log_event(rank, hostname, size, "redistribute", t0, t1);
+    log_event(rank, hostname, size, "redistribute", t0, t1, p0);
 
     return result;
 }
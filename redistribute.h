@@ -1,4 +1,10 @@
 #pragma once
+#include <cstdint>
+#include <string>
 #include "types.h"
 
+// FNV-1a: одинаков на всех узлах (в отличие от std::hash);
+// seed меняет порядок, не ломая детерминизм
+uint64_t stableHash(const std::string &s, uint64_t seed = 0);
+
 DataVec redistributeByKey(const DataVec &local);
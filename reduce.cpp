@@ -3,6 +3,7 @@
 
 #include <mpi.h>
 #include <sstream>
+#include <fstream>
 #include <algorithm>
 
 std::vector<MinDelta>
@@ -82,3 +83,34 @@ reduceMinDeltasMPI(const std::vector<MinDelta> &local)
 
     return global;  
 }
+
+void writeMinDeltaReport(std::ostream &out,
+                         const std::vector<MinDelta> &deltas,
+                         double threshold,
+                         int top,
+                         const std::string &valueColumn)
+{
+    out << "Country,City," << valueColumn << "\n";
+
+    int count = 0;
+    for (const auto &md : deltas) {
+        if (top >= 0 && count >= top) break;
+        if (md.delta <= threshold) continue;
+
+        auto sep = md.key.find('|');
+        out << md.key.substr(0, sep) << ","
+            << md.key.substr(sep + 1) << ","
+            << md.delta << "\n";
+        ++count;
+    }
+}
+
+void writeMinDeltaReport(const std::string &path,
+                         const std::vector<MinDelta> &deltas,
+                         double threshold,
+                         int top,
+                         const std::string &valueColumn)
+{
+    std::ofstream out(path);
+    writeMinDeltaReport(out, deltas, threshold, top, valueColumn);
+}
@@ -1,6 +1,22 @@
 #pragma once
 #include <vector>
+#include <string>
+#include <ostream>
 #include "types.h"
 
 std::vector<MinDelta>
 reduceMinDeltasMPI(const std::vector<MinDelta> &local);
+
+// rank 0: top записей с delta > threshold в CSV "Country,City,<valueColumn>";
+// top < 0 — без ограничения
+void writeMinDeltaReport(std::ostream &out,
+                         const std::vector<MinDelta> &deltas,
+                         double threshold,
+                         int top,
+                         const std::string &valueColumn = "MinAbsYearlyDelta");
+
+void writeMinDeltaReport(const std::string &path,
+                         const std::vector<MinDelta> &deltas,
+                         double threshold,
+                         int top,
+                         const std::string &valueColumn = "MinAbsYearlyDelta");
@@ -0,0 +1,325 @@
+#include "serve.h"
+#include "query.h"
+#include "reader.h"
+#include "logging.h"
+
+#include <mpi.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+bool serviceRequested()
+{
+    return std::getenv("SERVE_SOCKET") || std::getenv("SERVE_COMMANDS");
+}
+
+void addServiceUncertCuts(ScanFilter &filter)
+{
+    for (const auto &item : splitList(std::getenv("SERVE_UNCERT"))) {
+        try { filter.uncertCuts.push_back(std::stod(item)); }
+        catch (...) {}
+    }
+
+    auto &cuts = filter.uncertCuts;
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+}
+
+// ============================================================================
+// Источник запросов (только rank 0)
+// ============================================================================
+
+class QuerySource {
+public:
+    virtual ~QuerySource() = default;
+    // следующая строка; false — источник исчерпан
+    virtual bool next(std::string &line) = 0;
+    virtual void reply(const std::string &text) = 0;
+    // клиент попросил закрыть соединение
+    virtual void closeClient() {}
+};
+
+class FileSource : public QuerySource {
+public:
+    explicit FileSource(const std::string &path) : in_(path) {}
+
+    bool next(std::string &line) override
+    {
+        return static_cast<bool>(std::getline(in_, line));
+    }
+
+    void reply(const std::string &text) override
+    {
+        std::cout << text << std::flush;
+    }
+
+private:
+    std::ifstream in_;
+};
+
+class SocketSource : public QuerySource {
+public:
+    explicit SocketSource(const std::string &path) : path_(path)
+    {
+        listen_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_ < 0) return;
+
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+        ::unlink(path.c_str());
+        if (::bind(listen_, reinterpret_cast<sockaddr*>(&addr),
+                   sizeof(addr)) < 0 ||
+            ::listen(listen_, 4) < 0) {
+            std::cerr << "[serve] cannot listen on " << path << ": "
+                      << std::strerror(errno) << std::endl;
+            ::close(listen_);
+            listen_ = -1;
+        }
+    }
+
+    ~SocketSource() override
+    {
+        closeClient();
+        if (listen_ >= 0) {
+            ::close(listen_);
+            ::unlink(path_.c_str());
+        }
+    }
+
+    bool ok() const { return listen_ >= 0; }
+
+    bool next(std::string &line) override
+    {
+        if (listen_ < 0) return false;
+
+        while (true) {
+            auto nl = buf_.find('\n');
+            if (client_ >= 0 && nl != std::string::npos) {
+                line = buf_.substr(0, nl);
+                buf_.erase(0, nl + 1);
+                return true;
+            }
+
+            if (client_ < 0) {
+                client_ = ::accept(listen_, nullptr, nullptr);
+                if (client_ < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                buf_.clear();
+                continue;
+            }
+
+            char chunk[4096];
+            ssize_t n = ::read(client_, chunk, sizeof(chunk));
+            if (n > 0) {
+                buf_.append(chunk, n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                closeClient();   // клиент ушёл — ждём следующего
+            }
+        }
+    }
+
+    void reply(const std::string &text) override
+    {
+        std::size_t off = 0;
+        while (client_ >= 0 && off < text.size()) {
+            ssize_t n = ::send(client_, text.data() + off,
+                               text.size() - off, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                closeClient();
+                return;
+            }
+            off += n;
+        }
+    }
+
+    void closeClient() override
+    {
+        if (client_ >= 0) ::close(client_);
+        client_ = -1;
+        buf_.clear();
+    }
+
+private:
+    std::string path_;
+    int listen_ = -1;
+    int client_ = -1;
+    std::string buf_;
+};
+
+// ============================================================================
+// Цикл обслуживания
+// ============================================================================
+
+static std::string trim(const std::string &s)
+{
+    auto b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    auto e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+static std::string formatResult(const QueryConfig &q,
+                                const std::vector<MinDelta> &rows,
+                                double latency)
+{
+    std::ostringstream hdr;
+    hdr << std::fixed << std::setprecision(3) << latency * 1e3;
+
+    std::ostringstream out;
+    out << "# " << q.name << " stat=" << q.stat
+        << " rows=" << rows.size()
+        << " latency_ms=" << hdr.str() << "\n";
+
+    out << "Country,City," << queryValueColumn(q) << "\n";
+    for (const auto &md : rows) {
+        auto sep = md.key.find('|');
+        out << md.key.substr(0, sep) << ","
+            << md.key.substr(sep + 1) << ","
+            << md.delta << "\n";
+    }
+    out << "\n";
+    return out.str();
+}
+
+// Bcast без холостого прокручивания: в Open MPI блокирующий MPI_Bcast
+// опрашивает сеть в цикле и держит ядро на 100% всё время простоя.
+// Первые IDLE_SPIN секунд опрашиваем без пауз (серия запросов отвечается
+// быстро), дальше — с короткими паузами.
+static void waitBcastInt(int &value)
+{
+    const double IDLE_SPIN  = 0.01;
+    const auto   IDLE_SLEEP = std::chrono::microseconds(500);
+
+    MPI_Request req;
+    MPI_Ibcast(&value, 1, MPI_INT, 0, MPI_COMM_WORLD, &req);
+
+    double start = MPI_Wtime();
+    int done = 0;
+    while (true) {
+        MPI_Test(&req, &done, MPI_STATUS_IGNORE);
+        if (done) break;
+        if (MPI_Wtime() - start > IDLE_SPIN)
+            std::this_thread::sleep_for(IDLE_SLEEP);
+    }
+}
+
+void runService(const ScanFilter &scan, const DataVec &owned)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    char host[MPI_MAX_PROCESSOR_NAME];
+    int hostlen;
+    MPI_Get_processor_name(host, &hostlen);
+    std::string hostname(host);
+
+    // ----------------- AGGREGATE (один раз) -----------------
+    PerfSample p0 = perf_sample();
+    double t0 = MPI_Wtime();
+    auto agg = aggregateByBucket(owned, scan.uncertCuts.size());
+    double t1 = MPI_Wtime();
+    log_event(rank, hostname, size, "serve_aggregate", t0, t1, p0);
+
+    std::unique_ptr<QuerySource> source;
+
+    if (rank == 0) {
+        if (const char* path = std::getenv("SERVE_SOCKET")) {
+            auto sock = std::make_unique<SocketSource>(path);
+            if (sock->ok())
+                std::cerr << "[serve] listening on " << path << std::endl;
+            source = std::move(sock);
+        } else {
+            source = std::make_unique<FileSource>(std::getenv("SERVE_COMMANDS"));
+        }
+        std::cerr << "[serve] ready: " << agg.size()
+                  << " series on rank 0, " << size << " ranks" << std::endl;
+    }
+
+    int served = 0;
+
+    while (true) {
+        std::string line;
+        double trecv = 0.0;   // rank 0: когда запрос пришёл от клиента
+
+        if (rank == 0) {
+            bool got;
+            do {
+                got = source->next(line);
+                line = trim(line);
+                if (got && line == "quit") {
+                    source->closeClient();
+                    line.clear();
+                }
+            } while (got && line.empty());
+
+            if (!got) line = "shutdown";
+            trecv = MPI_Wtime();
+        }
+
+        int len = static_cast<int>(line.size());
+        waitBcastInt(len);
+        line.resize(len);
+        MPI_Bcast(&line[0], len, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+        // стадия query на всех rank'ах начинается после получения запроса,
+        // простой в ожидании следующей команды в timeline не попадает
+        PerfSample pq = perf_sample();
+        double tq0 = MPI_Wtime();
+
+        if (line == "shutdown")
+            break;
+
+        // все rank'и разбирают одну и ту же строку — решение согласовано
+        QueryConfig q;
+        std::string err;
+        bool ok = parseQueryConfig(line, q, err);
+        if (ok && !std::binary_search(scan.uncertCuts.begin(),
+                                      scan.uncertCuts.end(), q.uncertMax)) {
+            ok = false;
+            err = "uncert must be one of the loaded cutoffs (SERVE_UNCERT)";
+        }
+
+        if (!ok) {
+            if (rank == 0)
+                source->reply("# error: " + err + "\n\n");
+            continue;
+        }
+
+        auto rows = runQueryMPI(agg, scan, q);
+
+        if (rank == 0) {
+            double latency = MPI_Wtime() - trecv;
+            source->reply(formatResult(q, rows, latency));
+            std::cerr << "[serve] " << line << " -> " << rows.size()
+                      << " rows in " << latency * 1e3 << " ms" << std::endl;
+        }
+
+        log_event(rank, hostname, size, "query", tq0, MPI_Wtime(), pq);
+        ++served;
+    }
+
+    if (rank == 0) {
+        std::cerr << "[serve] shutdown after " << served << " queries"
+                  << std::endl;
+    }
+}
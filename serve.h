@@ -0,0 +1,18 @@
+#pragma once
+#include "types.h"
+
+// Долгоживущий режим: данные после redistribute остаются в памяти,
+// запросы (строки в формате QueryConfig) приходят на rank 0
+//   SERVE_SOCKET=<path>   — Unix-сокет, клиент: socat - UNIX-CONNECT:<path>
+//   SERVE_COMMANDS=<file> — файл/FIFO с запросами, ответы в stdout
+// Служебные команды: quit (закрыть соединение), shutdown (остановить).
+// SERVE_UNCERT=1.0;2.0 — дополнительные пороги uncert для запросов.
+
+// включён ли режим сервиса
+bool serviceRequested();
+
+// добавляет пороги неопределённости сервиса к фильтру чтения
+void addServiceUncertCuts(ScanFilter &filter);
+
+// коллективная: цикл обработки запросов до shutdown
+void runService(const ScanFilter &scan, const DataVec &owned);
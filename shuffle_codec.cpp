@@ -0,0 +1,363 @@
+#include "shuffle_codec.h"
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <stdexcept>
+
+// ============================================================================
+// varint / zigzag
+// ============================================================================
+
+static void putVarint(std::string &out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+static uint64_t getVarint(const unsigned char *&p, const unsigned char *end)
+{
+    uint64_t v = 0;
+    int shift = 0;
+    while (p < end) {
+        unsigned char b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return v;
+        shift += 7;
+    }
+    throw std::runtime_error("shuffle codec: truncated varint");
+}
+
+static uint64_t zigzag(int64_t v)
+{
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+// ============================================================================
+// LZ: блочный формат в духе LZ4
+//   token = [литералы:4][матч-4:4], длины >= 15 продолжаются байтами по 255,
+//   смещение — 2 байта LE, последняя последовательность — только литералы
+// ============================================================================
+
+static constexpr int LZ_MIN_MATCH = 4;
+static constexpr int LZ_HASH_BITS = 14;
+static constexpr std::size_t LZ_MAX_OFFSET = 65535;
+
+static uint32_t read32(const unsigned char *p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t lzHash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static void putLength(std::string &out, std::size_t len)
+{
+    while (len >= 255) {
+        out.push_back(static_cast<char>(255));
+        len -= 255;
+    }
+    out.push_back(static_cast<char>(len));
+}
+
+static void lzEmit(std::string &out,
+                   const unsigned char *lit, std::size_t litLen,
+                   std::size_t offset, std::size_t matchLen)
+{
+    std::size_t m = matchLen ? matchLen - LZ_MIN_MATCH : 0;
+
+    unsigned char token =
+        static_cast<unsigned char>((litLen < 15 ? litLen : 15) << 4) |
+        static_cast<unsigned char>(m < 15 ? m : 15);
+    out.push_back(static_cast<char>(token));
+
+    if (litLen >= 15) putLength(out, litLen - 15);
+    out.append(reinterpret_cast<const char*>(lit), litLen);
+
+    if (!matchLen) return;
+
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (m >= 15) putLength(out, m - 15);
+}
+
+static void lzCompress(const std::string &in, std::string &out)
+{
+    const unsigned char *src =
+        reinterpret_cast<const unsigned char*>(in.data());
+    std::size_t n = in.size();
+
+    std::vector<int64_t> table(std::size_t(1) << LZ_HASH_BITS, -1);
+
+    std::size_t i = 0, anchor = 0;
+
+    while (i + LZ_MIN_MATCH <= n) {
+        uint32_t cur = read32(src + i);
+        uint32_t h   = lzHash(cur);
+        int64_t ref  = table[h];
+        table[h] = static_cast<int64_t>(i);
+
+        if (ref < 0 ||
+            i - static_cast<std::size_t>(ref) > LZ_MAX_OFFSET ||
+            read32(src + ref) != cur) {
+            ++i;
+            continue;
+        }
+
+        std::size_t len = LZ_MIN_MATCH;
+        while (i + len < n && src[ref + len] == src[i + len])
+            ++len;
+
+        lzEmit(out, src + anchor, i - anchor,
+               i - static_cast<std::size_t>(ref), len);
+
+        i += len;
+        anchor = i;
+    }
+
+    lzEmit(out, src + anchor, n - anchor, 0, 0);
+}
+
+static std::size_t getLength(const unsigned char *&p,
+                             const unsigned char *end,
+                             std::size_t len)
+{
+    unsigned char b;
+    do {
+        if (p >= end)
+            throw std::runtime_error("shuffle codec: truncated length");
+        b = *p++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+
+static void lzDecompress(const unsigned char *p,
+                         const unsigned char *end,
+                         std::string &out)
+{
+    while (p < end) {
+        unsigned char token = *p++;
+
+        std::size_t litLen = token >> 4;
+        if (litLen == 15) litLen = getLength(p, end, litLen);
+        if (static_cast<std::size_t>(end - p) < litLen)
+            throw std::runtime_error("shuffle codec: truncated literals");
+
+        out.append(reinterpret_cast<const char*>(p), litLen);
+        p += litLen;
+
+        if (p == end) break;   // последняя последовательность
+
+        if (end - p < 2)
+            throw std::runtime_error("shuffle codec: truncated offset");
+        std::size_t offset = p[0] | (std::size_t(p[1]) << 8);
+        p += 2;
+
+        std::size_t len = token & 0x0F;
+        if (len == 15) len = getLength(p, end, len);
+        len += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > out.size())
+            throw std::runtime_error("shuffle codec: bad match offset");
+
+        // побайтно: матч может перекрываться с собой
+        std::size_t from = out.size() - offset;
+        for (std::size_t k = 0; k < len; ++k)
+            out.push_back(out[from + k]);
+    }
+}
+
+// ============================================================================
+// Серийное кодирование записей
+// ============================================================================
+
+enum : unsigned char {
+    FRAME_PACKED = 0,   // без LZ (сжатие не помогло)
+    FRAME_LZ     = 1
+};
+
+enum : unsigned char {
+    TEMP_FIXED = 0,     // x1000, в CSV не больше трёх знаков
+    TEMP_RAW   = 1      // double как есть
+};
+
+static constexpr double TEMP_SCALE = 1000.0;
+
+static bool fitsFixedPoint(double t)
+{
+    double q = std::llround(t * TEMP_SCALE) / TEMP_SCALE;
+    return q == t;
+}
+
+static void packSeries(std::string &out,
+                       const Record *const *begin,
+                       const Record *const *end)
+{
+    const std::string &key = (*begin)->key;
+    putVarint(out, key.size());
+    out.append(key);
+    putVarint(out, static_cast<uint64_t>(end - begin));
+
+    int64_t prevYear = 0;
+    for (auto it = begin; it != end; ++it) {
+        putVarint(out, zigzag((*it)->year - prevYear));
+        prevYear = (*it)->year;
+    }
+
+    bool fixed = true;
+    for (auto it = begin; it != end && fixed; ++it)
+        fixed = fitsFixedPoint((*it)->temp);
+
+    out.push_back(static_cast<char>(fixed ? TEMP_FIXED : TEMP_RAW));
+
+    if (fixed) {
+        int64_t prev = 0;
+        for (auto it = begin; it != end; ++it) {
+            int64_t q = std::llround((*it)->temp * TEMP_SCALE);
+            putVarint(out, zigzag(q - prev));
+            prev = q;
+        }
+    } else {
+        for (auto it = begin; it != end; ++it)
+            out.append(reinterpret_cast<const char*>(&(*it)->temp),
+                       sizeof(double));
+    }
+
+    // корзины неопределённости (batch-режим); обычно все нулевые
+    bool buckets = false;
+    for (auto it = begin; it != end && !buckets; ++it)
+        buckets = (*it)->bucket != 0;
+
+    out.push_back(static_cast<char>(buckets ? 1 : 0));
+    if (buckets)
+        for (auto it = begin; it != end; ++it)
+            putVarint(out, static_cast<uint64_t>((*it)->bucket));
+}
+
+void encodeShuffleFrame(const Record *const *begin,
+                        const Record *const *end,
+                        std::string &out,
+                        CodecStats &stats)
+{
+    std::string packed;
+
+    // reader отдаёт записи в порядке файла (сгруппированы по городу),
+    // поэтому серии — это просто подряд идущие записи с одним key
+    for (auto it = begin; it != end; ) {
+        auto runEnd = it + 1;
+        while (runEnd != end && (*runEnd)->key == (*it)->key)
+            ++runEnd;
+
+        packSeries(packed, it, runEnd);
+
+        stats.series += 1;
+        stats.records += runEnd - it;
+        stats.fullBytes += (runEnd - it) *
+            ((*it)->key.size() + sizeof(int) + sizeof(double));
+
+        it = runEnd;
+    }
+
+    std::string lz;
+    if (!packed.empty())
+        lzCompress(packed, lz);
+
+    std::size_t start = out.size();
+
+    if (!packed.empty() && lz.size() < packed.size()) {
+        out.push_back(static_cast<char>(FRAME_LZ));
+        putVarint(out, packed.size());
+        out.append(lz);
+    } else {
+        out.push_back(static_cast<char>(FRAME_PACKED));
+        putVarint(out, packed.size());
+        out.append(packed);
+    }
+
+    stats.packedBytes += packed.size();
+    stats.wireBytes   += out.size() - start;
+}
+
+void decodeShuffleFrame(const char *data,
+                        std::size_t len,
+                        DataVec &out)
+{
+    if (len == 0) return;
+
+    const unsigned char *p   = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char *end = p + len;
+
+    unsigned char mode = *p++;
+    std::size_t packedLen = getVarint(p, end);
+
+    std::string buf;
+    if (mode == FRAME_LZ) {
+        buf.reserve(packedLen);
+        lzDecompress(p, end, buf);
+        if (buf.size() != packedLen)
+            throw std::runtime_error("shuffle codec: size mismatch");
+        p   = reinterpret_cast<const unsigned char*>(buf.data());
+        end = p + buf.size();
+    } else if (static_cast<std::size_t>(end - p) != packedLen) {
+        throw std::runtime_error("shuffle codec: size mismatch");
+    }
+
+    while (p < end) {
+        std::size_t keyLen = getVarint(p, end);
+        if (static_cast<std::size_t>(end - p) < keyLen)
+            throw std::runtime_error("shuffle codec: truncated key");
+        std::string key(reinterpret_cast<const char*>(p), keyLen);
+        p += keyLen;
+
+        std::size_t n = getVarint(p, end);
+        std::size_t first = out.size();
+        out.resize(first + n);
+
+        int64_t year = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            year += unzigzag(getVarint(p, end));
+            out[first + i].key  = key;
+            out[first + i].year = static_cast<int>(year);
+        }
+
+        if (p >= end)
+            throw std::runtime_error("shuffle codec: truncated series");
+        unsigned char tempMode = *p++;
+
+        if (tempMode == TEMP_FIXED) {
+            int64_t q = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                q += unzigzag(getVarint(p, end));
+                out[first + i].temp = q / TEMP_SCALE;
+            }
+        } else {
+            if (static_cast<std::size_t>(end - p) < n * sizeof(double))
+                throw std::runtime_error("shuffle codec: truncated temps");
+            for (std::size_t i = 0; i < n; ++i) {
+                std::memcpy(&out[first + i].temp, p, sizeof(double));
+                p += sizeof(double);
+            }
+        }
+
+        if (p >= end)
+            throw std::runtime_error("shuffle codec: truncated series");
+        if (*p++)
+            for (std::size_t i = 0; i < n; ++i)
+                out[first + i].bucket = static_cast<int>(getVarint(p, end));
+    }
+}
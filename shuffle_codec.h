@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include "types.h"
+
+// Компактное кодирование буферов redistribute:
+//   записи группируются по сериям (подряд идущий key),
+//   годы — zigzag-дельты в varint,
+//   температуры — fixed-point (x1000) дельты в varint,
+//   поверх — простой LZ-компрессор без внешних зависимостей.
+
+// статистика кодирования одного rank'а
+struct CodecStats {
+    std::size_t records    = 0;
+    std::size_t series     = 0;
+    std::size_t fullBytes  = 0;   // key + int year + double temp на запись
+    std::size_t packedBytes = 0;  // после delta/varint
+    std::size_t wireBytes  = 0;   // после LZ (то, что уходит в сеть)
+};
+
+// кодирует записи [begin, end) одного адресата в самодостаточный кадр
+void encodeShuffleFrame(const Record *const *begin,
+                        const Record *const *end,
+                        std::string &out,
+                        CodecStats &stats);
+
+// декодирует кадр и дописывает записи в out
+void decodeShuffleFrame(const char *data,
+                        std::size_t len,
+                        DataVec &out);
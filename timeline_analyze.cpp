@@ -0,0 +1,526 @@
+// Анализ timeline.csv (одного или нескольких запусков):
+//   - дисбаланс стадий (max/mean),
+//   - критический путь,
+//   - ожидание на коллективах,
+//   - strong scaling по числу rank'ов,
+//   - экспорт в Chrome trace-event JSON (chrome://tracing, Perfetto).
+//
+// usage: timeline_analyze [--trace out.json] timeline.csv [more.csv ...]
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Event {
+    int         rank = 0;
+    std::string host;
+    int         size = 0;
+    std::string op;
+    double      t0 = 0.0;
+    double      t1 = 0.0;
+    double      dur = 0.0;
+    // дополнительные колонки (счётчики perf и т.п.)
+    std::vector<std::pair<std::string, std::string>> extra;
+};
+
+struct Run {
+    std::string        file;
+    int                size = 0;
+    std::vector<Event> events;
+};
+
+// Времена событий выровнены по program_total.t_start своего rank'а.
+// Вход в стадию считается коллективом: rank, пришедший раньше последнего,
+// простаивает — этот простой относится к предыдущей стадии (там он
+// пришёл рано), а в работу стадии идёт только время после latest_start.
+struct StageSummary {
+    std::string op;
+    int    depth = 0;       // вложенность относительно других стадий
+    int    ranks = 0;
+    double first_start  = 0.0;
+    double latest_start = 0.0; // вход последнего rank'а
+    double mean = 0.0;      // работа: t_end - max(t_start, latest_start)
+    double min  = 0.0;
+    double max  = 0.0;
+    int    slowest_rank = -1;
+    std::string slowest_host;
+    double wait_mean = 0.0; // ожидание на входе следующей стадии
+    double wait_max  = 0.0;
+    int    wait_rank = -1;
+    std::map<int, const Event*> events;
+};
+
+// ============================================================================
+// Чтение CSV
+// ============================================================================
+
+static std::vector<std::string> splitCSV(const std::string &line)
+{
+    std::vector<std::string> out;
+    std::stringstream ss(line);
+    std::string f;
+    while (std::getline(ss, f, ','))
+        out.push_back(f);
+    if (!line.empty() && line.back() == ',')
+        out.push_back("");
+    return out;
+}
+
+// MPI_Wtime не синхронизирован между узлами: время каждого rank'а
+// отсчитываем от его собственного program_total.t_start
+// (или от первого события, если program_total нет)
+static void alignRanks(Run &run)
+{
+    std::map<int, double> base;
+    for (const auto &e : run.events)
+        if (!base.count(e.rank) || e.t0 < base[e.rank])
+            base[e.rank] = e.t0;
+    for (const auto &e : run.events)
+        if (e.op == "program_total")
+            base[e.rank] = e.t0;
+
+    for (auto &e : run.events) {
+        e.t0 -= base[e.rank];
+        e.t1 -= base[e.rank];
+    }
+}
+
+static bool loadRun(const std::string &file, Run &run)
+{
+    std::ifstream in(file);
+    if (!in) {
+        std::cerr << "cannot open " << file << "\n";
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(in, line)) {
+        std::cerr << file << ": empty\n";
+        return false;
+    }
+
+    std::vector<std::string> header = splitCSV(line);
+    std::map<std::string, int> col;
+    for (int i = 0; i < (int)header.size(); ++i)
+        col[header[i]] = i;
+
+    static const char* const REQUIRED[] = {
+        "rank", "host", "size", "operation", "t_start", "t_end"
+    };
+    for (const char* name : REQUIRED) {
+        if (!col.count(name)) {
+            std::cerr << file << ": missing column " << name << "\n";
+            return false;
+        }
+    }
+
+    run.file = file;
+
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        std::vector<std::string> f = splitCSV(line);
+        if (f.size() < header.size()) continue;
+
+        Event e;
+        try {
+            e.rank = std::stoi(f[col["rank"]]);
+            e.host = f[col["host"]];
+            e.size = std::stoi(f[col["size"]]);
+            e.op   = f[col["operation"]];
+            e.t0   = std::stod(f[col["t_start"]]);
+            e.t1   = std::stod(f[col["t_end"]]);
+        } catch (...) {
+            continue;
+        }
+        e.dur = e.t1 - e.t0;
+
+        for (int i = 0; i < (int)header.size(); ++i) {
+            const std::string &h = header[i];
+            if (h == "rank" || h == "host" || h == "size" ||
+                h == "operation" || h == "t_start" || h == "t_end" ||
+                h == "duration")
+                continue;
+            if (!f[i].empty())
+                e.extra.emplace_back(h, f[i]);
+        }
+
+        run.size = std::max(run.size, e.size);
+        run.events.push_back(e);
+    }
+
+    alignRanks(run);
+    return !run.events.empty();
+}
+
+// ============================================================================
+// Сводка по стадиям
+// ============================================================================
+
+// Вложенность: стадия B внутри A, если на каждом общем rank'е
+// интервал B лежит внутри интервала A (shuffle_* внутри redistribute,
+// всё внутри program_total).
+static bool contains(const std::map<int, const Event*> &a,
+                     const std::map<int, const Event*> &b)
+{
+    bool any = false;
+    for (const auto &[rank, eb] : b) {
+        auto it = a.find(rank);
+        if (it == a.end()) continue;
+        const Event *ea = it->second;
+        if (eb->t0 < ea->t0 || eb->t1 > ea->t1)
+            return false;
+        any = true;
+    }
+    return any;
+}
+
+static std::vector<StageSummary> summarize(const Run &run)
+{
+    // (op, номер повторения) → rank → событие;
+    // повторяющиеся стадии (например, query в сервисе) — отдельные шаги
+    using StageId = std::pair<std::string, int>;
+    std::map<StageId, std::map<int, const Event*>> byOp;
+    std::map<StageId, int> seen;      // (op, rank) → сколько уже встретилось
+    std::map<std::string, int> repeats;
+
+    for (const auto &e : run.events) {
+        int k = seen[{ e.op, e.rank }]++;
+        byOp[{ e.op, k }].emplace(e.rank, &e);
+        repeats[e.op] = std::max(repeats[e.op], k + 1);
+    }
+
+    std::vector<StageSummary> res;
+
+    for (const auto &[id, ranks] : byOp) {
+        const auto &[op, k] = id;
+
+        StageSummary s;
+        s.op     = repeats[op] > 1 ? op + "#" + std::to_string(k + 1) : op;
+        s.ranks  = ranks.size();
+        s.events = ranks;
+        s.min    = 1e300;
+        s.first_start  = 1e300;
+        s.latest_start = -1e300;
+
+        for (const auto &[rank, e] : ranks) {
+            s.first_start  = std::min(s.first_start,  e->t0);
+            s.latest_start = std::max(s.latest_start, e->t0);
+        }
+
+        double sum = 0.0;
+        for (const auto &[rank, e] : ranks) {
+            double work = std::max(0.0, e->t1 - std::max(e->t0, s.latest_start));
+            sum += work;
+            s.min = std::min(s.min, work);
+            if (work > s.max || s.slowest_rank < 0) {
+                s.max = work;
+                s.slowest_rank = rank;
+                s.slowest_host = e->host;
+            }
+        }
+        s.mean = sum / s.ranks;
+
+        for (const auto &[other, oranks] : byOp)
+            if (other != id && contains(oranks, ranks) &&
+                !contains(ranks, oranks))
+                ++s.depth;
+
+        res.push_back(s);
+    }
+
+    std::sort(res.begin(), res.end(),
+              [](const StageSummary &a, const StageSummary &b) {
+                  if (a.first_start != b.first_start)
+                      return a.first_start < b.first_start;
+                  return a.depth < b.depth;
+              });
+
+    // Ожидание: следующая стадия того же уровня (в пределах родителя)
+    // начинается коллективом, который отпускает всех в latest_start.
+    // Rank, закончивший текущую стадию раньше, ждёт — это и есть его простой.
+    for (std::size_t i = 0; i < res.size(); ++i) {
+        StageSummary &s = res[i];
+
+        const StageSummary *next = nullptr;
+        for (std::size_t j = i + 1; j < res.size(); ++j) {
+            if (res[j].depth < s.depth) break;
+            if (res[j].depth == s.depth) { next = &res[j]; break; }
+        }
+        if (!next) continue;
+
+        double wsum = 0.0;
+        for (const auto &[rank, e] : s.events) {
+            if (!next->events.count(rank)) continue;
+            double w = std::max(0.0, next->latest_start - e->t1);
+            wsum += w;
+            if (w > s.wait_max) {
+                s.wait_max  = w;
+                s.wait_rank = rank;
+            }
+        }
+        s.wait_mean = wsum / s.ranks;
+    }
+    return res;
+}
+
+// максимум program_total (или охват всех событий, если его нет)
+static double runMakespan(const Run &run)
+{
+    double best = -1.0;
+    for (const auto &e : run.events)
+        if (e.op == "program_total")
+            best = std::max(best, e.dur);
+    if (best >= 0.0) return best;
+
+    double lo = 1e300, hi = -1e300;
+    for (const auto &e : run.events) {
+        lo = std::min(lo, e.t0);
+        hi = std::max(hi, e.t1);
+    }
+    return hi - lo;
+}
+
+// ============================================================================
+// Отчёты
+// ============================================================================
+
+static void reportRun(const Run &run)
+{
+    auto stages = summarize(run);
+
+    std::cout << "== " << run.file << " (ranks=" << run.size << ")\n";
+    std::cout << std::fixed << std::setprecision(6);
+
+    std::cout << std::left
+              << std::setw(22) << "stage"
+              << std::right
+              << std::setw(12) << "mean"
+              << std::setw(12) << "max"
+              << std::setw(10) << "max/mean"
+              << std::setw(12) << "wait_mean"
+              << std::setw(12) << "wait_max"
+              << std::setw(6)  << "by"
+              << "  slowest\n";
+
+    for (const auto &s : stages) {
+        std::string name = std::string(2 * s.depth, ' ') + s.op;
+        std::cout << std::left << std::setw(22) << name << std::right
+                  << std::setw(12) << s.mean
+                  << std::setw(12) << s.max
+                  << std::setw(10) << std::setprecision(3)
+                  << (s.mean > 0 ? s.max / s.mean : 1.0)
+                  << std::setprecision(6)
+                  << std::setw(12) << s.wait_mean
+                  << std::setw(12) << s.wait_max
+                  << std::setw(6)
+                  << (s.wait_rank < 0 ? "-" : std::to_string(s.wait_rank))
+                  << "  rank " << s.slowest_rank
+                  << " (" << s.slowest_host << ")\n";
+    }
+
+    // Критический путь: последовательные стадии верхнего уровня
+    // (глубина 1 под program_total, либо 0 если его нет).
+    int minDepth = 1 << 30;
+    for (const auto &s : stages) minDepth = std::min(minDepth, s.depth);
+    bool haveRoot = false;
+    for (const auto &s : stages)
+        if (s.depth == minDepth && s.op == "program_total") haveRoot = true;
+    int pathDepth = haveRoot ? minDepth + 1 : minDepth;
+
+    std::vector<const StageSummary*> steps;
+    for (const auto &s : stages)
+        if (s.depth == pathDepth) steps.push_back(&s);
+
+    // Обратный проход от rank'а, закончившего последним: на каждой стадии
+    // путь идёт по rank'у, который последним дошёл до следующего
+    // коллектива, и начинается не раньше входа последнего rank'а.
+    // Отрезки не пересекаются, поэтому сумма не превышает makespan.
+    double total = runMakespan(run);
+    double upper = total;
+
+    struct Segment { const StageSummary *s; int rank; std::string host; double len; };
+    std::vector<Segment> path;
+
+    for (auto it = steps.rbegin(); it != steps.rend(); ++it) {
+        const StageSummary *s = *it;
+
+        const Event *last = nullptr;
+        for (const auto &[rank, e] : s->events)
+            if (!last || e->t1 > last->t1) last = e;
+
+        double end   = std::min(last->t1, upper);
+        double begin = std::min(end, std::max(last->t0, s->latest_start));
+        path.push_back({ s, last->rank, last->host, end - begin });
+        upper = begin;
+    }
+    std::reverse(path.begin(), path.end());
+
+    double sum = 0.0;
+    std::cout << "critical path:";
+    for (const auto &seg : path) {
+        std::cout << "\n  " << std::left << std::setw(20) << seg.s->op
+                  << std::right << std::setw(12) << seg.len
+                  << "  rank " << seg.rank
+                  << " (" << seg.host << ")";
+        sum += seg.len;
+    }
+    std::cout << "\n  sum=" << sum
+              << " makespan=" << total
+              << " uninstrumented=" << total - sum
+              << "\n\n";
+}
+
+static void reportScaling(const std::vector<Run> &runs)
+{
+    // size → makespan'ы
+    std::map<int, std::vector<double>> bySize;
+    for (const auto &r : runs)
+        bySize[r.size].push_back(runMakespan(r));
+
+    if (bySize.size() < 2) return;
+
+    int p0 = bySize.begin()->first;
+    double T0 = 0.0;
+    for (double t : bySize.begin()->second) T0 += t;
+    T0 /= bySize.begin()->second.size();
+
+    std::cout << "== strong scaling (baseline ranks=" << p0 << ")\n";
+    std::cout << std::setw(8) << "ranks" << std::setw(6) << "runs"
+              << std::setw(12) << "time"
+              << std::setw(10) << "speedup"
+              << std::setw(12) << "efficiency\n";
+
+    for (const auto &[p, ts] : bySize) {
+        double T = 0.0;
+        for (double t : ts) T += t;
+        T /= ts.size();
+
+        double speedup = T > 0 ? T0 / T : 0.0;
+        std::cout << std::setw(8) << p << std::setw(6) << ts.size()
+                  << std::setw(12) << std::setprecision(6) << T
+                  << std::setw(10) << std::setprecision(3) << speedup
+                  << std::setw(11) << speedup * p0 / p << "\n";
+    }
+    std::cout << "\n";
+}
+
+// ============================================================================
+// Chrome trace-event JSON
+// ============================================================================
+
+static std::string jsonEscape(const std::string &s)
+{
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out.push_back(c);
+    }
+    return out;
+}
+
+static bool writeTrace(const std::vector<Run> &runs, const std::string &path)
+{
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "cannot write " << path << "\n";
+        return false;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[\n";
+
+    bool first = true;
+    auto sep = [&]() { out << (first ? "" : ",\n"); first = false; };
+
+    for (std::size_t pid = 0; pid < runs.size(); ++pid) {
+        const Run &run = runs[pid];
+
+        sep();
+        out << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << pid
+            << ",\"args\":{\"name\":\"" << jsonEscape(run.file)
+            << " (" << run.size << " ranks)\"}}";
+
+        std::map<int, std::string> hosts;
+        for (const auto &e : run.events) hosts[e.rank] = e.host;
+
+        for (const auto &[rank, host] : hosts) {
+            sep();
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid
+                << ",\"tid\":" << rank
+                << ",\"args\":{\"name\":\"rank " << rank
+                << " (" << jsonEscape(host) << ")\"}}";
+        }
+
+        for (const auto &e : run.events) {
+            sep();
+            out << "{\"ph\":\"X\",\"name\":\"" << jsonEscape(e.op)
+                << "\",\"pid\":" << pid
+                << ",\"tid\":" << e.rank
+                << ",\"ts\":" << e.t0 * 1e6
+                << ",\"dur\":" << e.dur * 1e6
+                << ",\"args\":{\"host\":\"" << jsonEscape(e.host) << "\"";
+            for (const auto &[k, v] : e.extra)
+                out << ",\"" << jsonEscape(k) << "\":\"" << jsonEscape(v)
+                    << "\"";
+            out << "}}";
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return true;
+}
+
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    std::string tracePath;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (a == "-h" || a == "--help") {
+            std::cout << "usage: " << argv[0]
+                      << " [--trace out.json] timeline.csv [more.csv ...]\n";
+            return 0;
+        } else {
+            files.push_back(a);
+        }
+    }
+
+    if (files.empty())
+        files.push_back("timeline.csv");
+
+    std::vector<Run> runs;
+    for (const auto &f : files) {
+        Run r;
+        if (loadRun(f, r))
+            runs.push_back(std::move(r));
+    }
+
+    if (runs.empty()) {
+        std::cerr << "no timeline data\n";
+        return 1;
+    }
+
+    for (const auto &r : runs)
+        reportRun(r);
+
+    reportScaling(runs);
+
+    if (!tracePath.empty()) {
+        if (!writeTrace(runs, tracePath))
+            return 1;
+        std::cout << "trace written to " << tracePath << "\n";
+    }
+
+    return 0;
+}
@@ -3,11 +3,13 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <climits>
 
 struct Record {
     std::string key;   // "Country|City"
     int year;
     double temp;
+    int bucket = 0;    // корзина неопределённости (batch-режим)
 };
 
 struct Stat {
@@ -29,3 +31,27 @@ struct MinDelta {
     std::string key;
     double delta;
 };
+
+// Предикаты чтения (страны/города/окно лет); пустой — читаем всё
+struct ScanFilter {
+    std::vector<std::string> countries;
+    std::vector<std::string> cities;
+    int yearFrom = INT_MIN;
+    int yearTo   = INT_MAX;
+
+    // Пороги неопределённости по возрастанию: строка берётся,
+    // если uncert <= последнего; Record::bucket — первый порог >= uncert
+    std::vector<double> uncertCuts = { 3.0 };
+
+    // Быстрый предпросмотр: доля диапазонов индекса (стратифицированно
+    // по странам); 1.0 — читаем всё
+    double   sampleFraction = 1.0;
+    unsigned sampleSeed     = 0;
+
+    bool sampling() const { return sampleFraction < 1.0; }
+
+    bool active() const {
+        return !countries.empty() || !cities.empty() ||
+               yearFrom != INT_MIN || yearTo != INT_MAX;
+    }
+};